@@ -3,16 +3,49 @@
 * to create an illuminated textured chair with a user operated camera by holding left alt and dragging mouse while holding right mouse button
 * the option to rotate the camera around the object by holding down a key the s key
 * shaders are used to add color and texture to the primitives
+* with OpenGL 4.3 the planes are culled by a compute shader and drawn with one multi draw indirect per material, the g key switches back to drawing one plane at a time
+* per-frame data is written into a fenced ring buffer and transient allocations come from a frame arena, the p key prints their statistics
+* run with --turntable N [--size WxH] [--output prefix] to render N views around the chair in a single layered pass and save them as PNG files
+* run with --render-sequence N [--workers N] [--batch N] [--retries N] [--timeout seconds] [--transport local|tcp] [--listen host:port] to split N orbit frames
+* across worker processes and collect them in order into prefix.ppm, other nodes join a tcp coordinator with --worker-connect host:port
+* offscreen runs render in a hidden window, without DISPLAY or WAYLAND_DISPLAY on Linux they need GLFW 3.4 to create a surfaceless
+* EGL context, with older GLFW versions every worker needs a display server such as a virtual X server
+* vertices are packed into 16 bytes with half float positions and texture coordinates and 10 bit normals, run with --vertex-format float for 32 byte float vertices
 * Author: Michael Swift
 */
 #include <GLEW/glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <deque>
+#include <map>
+#include <thread>
+#include <chrono>
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <SOIL2/SOIL2.h>
 
@@ -36,6 +69,7 @@ GLfloat fov = 45.0f;
 
 void initiateCamera();
 void spinCamera();
+glm::vec3 orbitPosition(GLfloat angle);
 
 // Define Camera Attributes
 glm::vec3 cameraPosition = glm::vec3(0.0f, 1.0f, 4.0f); 
@@ -70,16 +104,1452 @@ bool firstMouseMove = true;
 // Light source position
 glm::vec3 lightPosition(1.0f, 1.0f, 1.0f);
 
+// Materials used by the scene, each material is drawn with its own texture
+enum Material { MATERIAL_WOOD, MATERIAL_GRID, MATERIAL_COUNT };
+
+// Object instance as stored in the instance SSBO, matches the std430 layout in the shaders
+struct SceneInstance
+{
+	glm::mat4 model;
+	glm::vec4 bounds; // World space bounding sphere, xyz is the center and w the radius
+	GLuint material;
+	GLuint lodFirst;
+	GLuint lodCount;
+	GLuint padding;
+};
+
+// Level of detail entry, the index range drawn for a mesh up to a camera distance
+struct MeshLod
+{
+	GLuint indexCount;
+	GLuint firstIndex;
+	GLfloat maxDistance;
+	GLuint padding;
+};
+
+// Indirect draw command written by the culling compute shader
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Work group size of the culling compute shader
+const GLuint CULL_GROUP_SIZE = 64;
+
+// GPU-driven rendering needs OpenGL 4.3, toggle between paths with the G key
+bool gpuDrivenSupported = false, gpuDriven = false;
+
+// Per-frame data shared by the shaders through the FrameData uniform block, matches the std140 layout
+struct FrameUniforms
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 viewPos;
+	glm::vec4 lightPos;
+	glm::vec4 lightColor;
+	glm::vec4 objectColor;
+	glm::vec4 frustumPlanes[6];
+};
+
+// Uniform block binding point of the per-frame data
+const GLuint FRAME_UNIFORM_BINDING = 0;
+
+// Number of frames the GPU ring buffer can have in flight
+const GLuint RING_REGIONS = 3;
+
+// Print allocator and ring buffer statistics with the P key
+bool printStats = false;
+
+// Per-view data read from the view SSBO, matches the std430 layout in the shaders
+struct ViewUniforms
+{
+	glm::mat4 viewProjection;
+	glm::vec4 viewPos;
+	glm::vec4 frustumPlanes[6];
+};
+
+// Storage buffer binding point of the per-view data
+const GLuint VIEW_STORAGE_BINDING = 3;
+
+// Most views rendered into the layers of the multi-view target in a single pass
+const GLuint MAX_VIEWS = 64;
+
+// Limits of the offscreen output options
+const GLsizei MAX_OUTPUT_SIZE = 16384;
+const GLuint MAX_TURNTABLE_VIEWS = 100000;
+const GLuint MAX_SEQUENCE_FRAMES = 1000000;
+const GLuint MAX_SEQUENCE_WORKERS = 256;
+const GLuint MAX_SEQUENCE_RETRIES = 100;
+const GLuint MAX_SEQUENCE_TIMEOUT = 3600;
+
+// Bytes of each ring buffer region, a multi-view pass must fit its frame data and every view with the largest offset alignment
+const GLsizeiptr FRAME_RING_BYTES = 64 * 1024;
+const GLsizeiptr MAX_RING_ALIGNMENT = 256;
+static_assert(sizeof(FrameUniforms) + MAX_VIEWS * sizeof(ViewUniforms) + 2 * MAX_RING_ALIGNMENT <= FRAME_RING_BYTES,
+	"Ring buffer region is too small for a full multi-view pass");
+
+// Scene data and GPU objects needed to draw the scene through the GPU-driven path
+struct SceneResources
+{
+	GLuint instanceCount;
+	GLuint materialFirst[MATERIAL_COUNT], materialCount[MATERIAL_COUNT];
+	GLuint materialTextures[MATERIAL_COUNT];
+	GLuint indirectVAO, instanceSSBO, lodSSBO, commandBuffer;
+	GLuint cullProgram, multiViewProgram;
+};
+
+// Layered render target, every view is rendered into its own layer of the texture arrays
+struct MultiViewTarget
+{
+	GLuint framebuffer, readFramebuffer, colorArray, depthArray;
+	GLsizei width, height;
+	GLuint layers;
+};
+
+// Options of the sharded sequence renderer, a coordinator hands frame ranges to worker processes of this renderer
+struct SequenceOptions
+{
+	GLuint frameTotal;
+	GLuint workers;
+	GLuint batch;
+	GLuint retries;
+	GLuint timeout; // Seconds a busy worker may go without sending anything
+	GLsizei width, height;
+	bool packedVertices;
+	string outputPath;
+	bool tcp;
+	string listenAddress;
+	string executable;
+	int workerFd;
+	string connectAddress;
+};
+
+// First message of a worker connecting over tcp, lets the coordinator kill a stalled stand-in it spawned itself
+struct WorkerHello
+{
+	uint32_t pid;
+};
+
+// Sequence settings sent to a worker once it is connected
+struct SequenceConfig
+{
+	uint32_t frameTotal;
+	uint32_t width;
+	uint32_t height;
+	uint32_t packedVertices;
+	uint32_t batch; // Most frames requested at once, sizes the worker's render target
+};
+
+// Range of frames requested from a worker, a count of zero tells the worker to exit
+struct FrameRequest
+{
+	uint32_t firstFrame;
+	uint32_t count;
+};
+
+// Header sent by a worker in front of each frame's RGB pixels
+struct FrameHeader
+{
+	uint32_t frame;
+	uint32_t width;
+	uint32_t height;
+};
+
+// Attribute of a vertex format, where a source attribute is stored in the vertex and how the shaders read it
+struct VertexAttribute
+{
+	GLuint location;
+	GLint components;
+	GLenum type; // GL_FLOAT, GL_HALF_FLOAT or GL_INT_2_10_10_10_REV, integer attributes use GL_UNSIGNED_INT
+	GLboolean normalized;
+	GLuint offset; // Byte offset in the encoded vertex
+	GLuint sourceOffset; // Float offset in the source vertex
+	bool integer; // Read as an integer by the shader instead of converted to float
+	GLuint divisor; // Instances per element, 0 advances once per vertex
+};
+
+// Vertex format descriptor, both the vertex encoding and the VAO setup are derived from it
+struct VertexFormat
+{
+	string name;
+	GLsizei stride;
+	GLuint sourceFloats; // Floats per source vertex
+	vector<VertexAttribute> attributes;
+};
+
+// Source vertices as floats, position, texture coordinate and normal, 32 bytes per vertex
+const VertexFormat FLOAT_VERTEX_FORMAT = { "float", 32, 8, {
+	{ 0, 3, GL_FLOAT, GL_FALSE, 0, 0, false, 0 },
+	{ 2, 2, GL_FLOAT, GL_FALSE, 12, 3, false, 0 },
+	{ 3, 3, GL_FLOAT, GL_FALSE, 20, 5, false, 0 } } };
+
+// Half float position padded to 8 bytes, half float texture coordinate and a normal with 10 bits per component, 16 bytes per vertex
+const VertexFormat PACKED_VERTEX_FORMAT = { "packed", 16, 8, {
+	{ 0, 3, GL_HALF_FLOAT, GL_FALSE, 0, 0, false, 0 },
+	{ 2, 2, GL_HALF_FLOAT, GL_FALSE, 8, 3, false, 0 },
+	{ 3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 12, 5, false, 0 } } };
+
+// Lamp vertices only have a position
+const VertexFormat LAMP_VERTEX_FORMAT = { "lamp", 12, 3, {
+	{ 0, 3, GL_FLOAT, GL_FALSE, 0, 0, false, 0 } } };
+
+// Per-command index of the GPU-driven VAO, read at baseInstance of each draw command, uploaded as is without a source vertex
+const VertexFormat INSTANCE_INDEX_FORMAT = { "instance", sizeof(GLuint), 0, {
+	{ 4, 1, GL_UNSIGNED_INT, GL_FALSE, 0, 0, true, 1 } } };
+
 // Draw Primitive(s)
 void draw()
 {
-	GLenum mode = GL_TRIANGLES;
-	GLsizei indices = 6;
-	glDrawElements(mode, indices, GL_UNSIGNED_BYTE, nullptr);
+	GLenum mode = GL_TRIANGLES;
+	GLsizei indices = 6;
+	glDrawElements(mode, indices, GL_UNSIGNED_BYTE, nullptr);
+
+
+}
+
+// Create a scene instance and its bounding sphere from the plane's model matrix
+static SceneInstance MakeInstance(const glm::mat4& modelMatrix, GLuint material)
+{
+	// Corners of the plane primitive before transformation
+	glm::vec4 corners[] = {
+		glm::vec4(-0.25f, -0.25f, 0.0f, 1.0f),
+		glm::vec4(-0.25f, 0.25f, 0.0f, 1.0f),
+		glm::vec4(0.25f, -0.25f, 0.0f, 1.0f),
+		glm::vec4(0.25f, 0.25f, 0.0f, 1.0f)
+	};
+
+	glm::vec3 worldCorners[4];
+	glm::vec3 center(0.0f);
+	for (GLuint i = 0; i < 4; i++)
+	{
+		worldCorners[i] = glm::vec3(modelMatrix * corners[i]);
+		center += worldCorners[i] * 0.25f;
+	}
+
+	GLfloat radius = 0.0f;
+	for (GLuint i = 0; i < 4; i++)
+		radius = max(radius, glm::distance(center, worldCorners[i]));
+
+	SceneInstance instance;
+	instance.model = modelMatrix;
+	instance.bounds = glm::vec4(center, radius);
+	instance.material = material;
+	instance.lodFirst = 0;
+	instance.lodCount = 2; // Subdivided and single quad levels of the plane
+	instance.padding = 0;
+	return instance;
+}
+
+// Encode source vertices into the layout of a vertex format
+static vector<unsigned char> EncodeVertices(const VertexFormat& format, const GLfloat* source, GLuint vertexCount)
+{
+	vector<unsigned char> encoded(vertexCount * format.stride, 0);
+	for (GLuint v = 0; v < vertexCount; v++)
+	{
+		const GLfloat* vertex = source + v * format.sourceFloats;
+		unsigned char* destination = encoded.data() + v * format.stride;
+		for (GLuint i = 0; i < format.attributes.size(); i++)
+		{
+			const VertexAttribute& attribute = format.attributes[i];
+			const GLfloat* value = vertex + attribute.sourceOffset;
+			unsigned char* target = destination + attribute.offset;
+
+			if (attribute.type == GL_HALF_FLOAT)
+			{
+				for (GLint c = 0; c < attribute.components; c++)
+				{
+					uint16_t half = glm::packHalf1x16(value[c]);
+					memcpy(target + c * sizeof(half), &half, sizeof(half));
+				}
+			}
+			else if (attribute.type == GL_INT_2_10_10_10_REV)
+			{
+				// xyz in 10 bit signed normalized components, the 2 bit w is unused
+				uint32_t packed = glm::packSnorm3x10_1x2(glm::vec4(value[0], value[1], value[2], 0.0f));
+				memcpy(target, &packed, sizeof(packed));
+			}
+			else
+				memcpy(target, value, attribute.components * sizeof(GLfloat));
+		}
+	}
+	return encoded;
+}
+
+// Specify the attributes of a vertex format for the bound VAO and vertex buffer
+static void SetVertexFormat(const VertexFormat& format)
+{
+	for (GLuint i = 0; i < format.attributes.size(); i++)
+	{
+		const VertexAttribute& attribute = format.attributes[i];
+		if (attribute.integer)
+			glVertexAttribIPointer(attribute.location, attribute.components, attribute.type, format.stride, (GLvoid*)(size_t)attribute.offset);
+		else
+			glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, format.stride, (GLvoid*)(size_t)attribute.offset);
+		glVertexAttribDivisor(attribute.location, attribute.divisor);
+		glEnableVertexAttribArray(attribute.location);
+	}
+}
+
+// Extract the six frustum planes from a view projection matrix, normals point inside the frustum
+static void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+	glm::vec4 rows[4];
+	for (GLuint i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+	// Left, right, bottom, top, near and far planes
+	for (GLuint i = 0; i < 3; i++)
+	{
+		planes[i * 2] = rows[3] + rows[i];
+		planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+
+	for (GLuint i = 0; i < 6; i++)
+		planes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+}
+
+// Test a bounding sphere against the frustum planes
+static bool SphereInFrustum(const glm::vec4& bounds, const glm::vec4 planes[6])
+{
+	for (GLuint i = 0; i < 6; i++)
+		if (glm::dot(glm::vec3(planes[i]), glm::vec3(bounds)) + planes[i].w < -bounds.w)
+			return false;
+	return true;
+}
+
+/*
+* Linear allocator for transient CPU data, reset once per frame
+* Allocations that do not fit are served from the heap and the arena grows to hold the frame's total on the next reset
+*/
+class FrameArena
+{
+public:
+	struct Stats
+	{
+		size_t capacity;
+		size_t lastFrameBytes;
+		size_t lastFrameAllocations;
+		size_t peakFrameBytes;
+		size_t overflowFrames;
+	};
+
+	explicit FrameArena(size_t capacity) : memory(capacity), offset(0), overflowBytes(0), allocations(0), maxAlignment(1)
+	{
+		stats = Stats();
+		stats.capacity = capacity;
+	}
+
+	~FrameArena()
+	{
+		for (size_t i = 0; i < overflow.size(); i++)
+			delete[] overflow[i];
+	}
+
+	// Alignment must be a power of two no larger than the default new alignment
+	void* allocate(size_t size, size_t alignment = 16)
+	{
+		allocations++;
+		maxAlignment = max(maxAlignment, alignment);
+		size_t start = (offset + alignment - 1) & ~(alignment - 1);
+		if (start + size <= memory.size())
+		{
+			offset = start + size;
+			return memory.data() + start;
+		}
+
+		overflow.push_back(new unsigned char[size]);
+		overflowBytes += size;
+		return overflow.back();
+	}
+
+	template<typename T>
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	// Release everything allocated this frame
+	void reset()
+	{
+		size_t frameBytes = offset + overflowBytes;
+		stats.lastFrameBytes = frameBytes;
+		stats.lastFrameAllocations = allocations;
+		stats.peakFrameBytes = max(stats.peakFrameBytes, frameBytes);
+
+		if (!overflow.empty())
+		{
+			size_t overflowCount = overflow.size();
+			for (size_t i = 0; i < overflow.size(); i++)
+				delete[] overflow[i];
+			overflow.clear();
+
+			// Leave room for the alignment padding of every allocation that overflowed and never shrink
+			size_t capacity = max(2 * memory.size(), frameBytes + maxAlignment * overflowCount);
+			stats.overflowFrames++;
+			memory = vector<unsigned char>(capacity);
+			stats.capacity = capacity;
+		}
+
+		offset = 0;
+		overflowBytes = 0;
+		allocations = 0;
+		maxAlignment = 1;
+	}
+
+	const Stats& getStats() const { return stats; }
+
+private:
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+
+	vector<unsigned char> memory;
+	size_t offset, overflowBytes, allocations, maxAlignment;
+	vector<unsigned char*> overflow;
+	Stats stats;
+};
+
+/*
+* Triple buffered GPU ring buffer for dynamic per-frame data
+* Each frame writes into its own region of a persistently mapped buffer, a fence placed at the end of the frame
+* keeps the region from being overwritten until the GPU is done reading it
+* Without OpenGL 4.4 buffer storage the writes are staged in memory and uploaded with glBufferSubData on flush
+*/
+class GpuRingBuffer
+{
+public:
+	struct Stats
+	{
+		GLsizeiptr regionSize;
+		GLsizeiptr lastFrameBytes;
+		GLsizeiptr peakFrameBytes;
+		size_t frames;
+		size_t stalledFrames;
+		double stallSeconds;
+		size_t overflows;
+		bool persistent;
+	};
+
+	GpuRingBuffer() : buffer(0), mapped(nullptr), regionSize(0), alignment(16), region(0), head(0), flushed(0)
+	{
+		for (GLuint i = 0; i < RING_REGIONS; i++)
+			fences[i] = 0;
+		stats = Stats();
+	}
+
+	void create(GLsizeiptr size)
+	{
+		regionSize = size;
+		stats.regionSize = size;
+
+		// Offsets must satisfy every binding target the ring is used with
+		GLint uniformAlignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		alignment = max(alignment, (GLsizeiptr)uniformAlignment);
+		if (GLEW_VERSION_4_3)
+		{
+			GLint storageAlignment = 0;
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+			alignment = max(alignment, (GLsizeiptr)storageAlignment);
+		}
+		regionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * RING_REGIONS, nullptr, flags);
+			mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * RING_REGIONS, flags);
+		}
+		else
+		{
+			glBufferData(GL_COPY_WRITE_BUFFER, regionSize * RING_REGIONS, nullptr, GL_STREAM_DRAW);
+			staging.resize(regionSize * RING_REGIONS);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		stats.persistent = mapped != nullptr;
+	}
+
+	void destroy()
+	{
+		for (GLuint i = 0; i < RING_REGIONS; i++)
+		{
+			if (fences[i])
+				glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+
+		if (mapped)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			mapped = nullptr;
+		}
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+
+	// Move to the next region, waiting for the GPU if it is still reading it
+	void beginFrame()
+	{
+		region = (region + 1) % RING_REGIONS;
+		head = 0;
+		flushed = 0;
+
+		if (!fences[region])
+			return;
+
+		GLenum result = glClientWaitSync(fences[region], 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			stats.stalledFrames++;
+			double start = glfwGetTime();
+			do
+				result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			while (result == GL_TIMEOUT_EXPIRED);
+			stats.stallSeconds += glfwGetTime() - start;
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = 0;
+	}
+
+	// Reserve space in this frame's region, returns nullptr if the region is full
+	void* allocate(GLsizeiptr size, GLintptr& offset)
+	{
+		GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+		if (start + size > regionSize)
+		{
+			stats.overflows++;
+			return nullptr;
+		}
+
+		head = start + size;
+		offset = region * regionSize + start;
+		return (mapped ? mapped : staging.data()) + offset;
+	}
+
+	// Make the writes since the last flush visible to the GPU
+	void flush()
+	{
+		if (!mapped && head > flushed)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, region * regionSize + flushed, head - flushed, staging.data() + region * regionSize + flushed);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+		flushed = head;
+	}
+
+	// Fence the region once every command reading it has been issued
+	void endFrame()
+	{
+		flush();
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		stats.frames++;
+		stats.lastFrameBytes = head;
+		stats.peakFrameBytes = max(stats.peakFrameBytes, head);
+	}
+
+	GLuint getBuffer() const { return buffer; }
+	const Stats& getStats() const { return stats; }
+
+private:
+	GLuint buffer;
+	unsigned char* mapped;
+	vector<unsigned char> staging;
+	GLsizeiptr regionSize, alignment;
+	GLsync fences[RING_REGIONS];
+	GLuint region;
+	GLsizeiptr head, flushed;
+	Stats stats;
+};
+
+// Print frame allocator and ring buffer statistics
+static void PrintFrameStats(const FrameArena& arena, const GpuRingBuffer& ring)
+{
+	const FrameArena::Stats& arenaStats = arena.getStats();
+	const GpuRingBuffer::Stats& ringStats = ring.getStats();
+
+	cout << "Frame arena: " << arenaStats.lastFrameBytes << " bytes in " << arenaStats.lastFrameAllocations
+		<< " allocations last frame, peak " << arenaStats.peakFrameBytes << " of " << arenaStats.capacity
+		<< " bytes, " << arenaStats.overflowFrames << " overflowed frames" << endl;
+	cout << "Ring buffer: " << (ringStats.persistent ? "persistent" : "staged") << ", " << ringStats.lastFrameBytes
+		<< " bytes last frame, peak " << ringStats.peakFrameBytes << " of " << ringStats.regionSize << " bytes, "
+		<< ringStats.stalledFrames << " of " << ringStats.frames << " frames stalled for " << ringStats.stallSeconds * 1000.0
+		<< " ms, " << ringStats.overflows << " overflows" << endl;
+}
+
+// Attach a program's FrameData uniform block to the per-frame binding point
+static void BindFrameUniformBlock(GLuint program)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(program, "FrameData");
+	if (blockIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, blockIndex, FRAME_UNIFORM_BINDING);
+}
+
+/*
+* Fill the per-frame data, copy it into the ring buffer and bind it to the FrameData block
+* The mapping is write only, so the caller keeps the filled copy for reading, returns false if the ring region is full
+*/
+static bool WriteFrameUniforms(GpuRingBuffer& ring, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos,
+	FrameUniforms& frameUniforms)
+{
+	frameUniforms.view = view;
+	frameUniforms.projection = projection;
+	frameUniforms.viewPos = glm::vec4(viewPos, 1.0f);
+	frameUniforms.lightPos = glm::vec4(lightPosition, 1.0f);
+	frameUniforms.lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	frameUniforms.objectColor = glm::vec4(0.76f, 0.60f, 0.32f, 1.0f);
+	ExtractFrustumPlanes(projection * view, frameUniforms.frustumPlanes);
+
+	GLintptr offset = 0;
+	void* destination = ring.allocate(sizeof(FrameUniforms), offset);
+	if (!destination)
+		return false;
+	memcpy(destination, &frameUniforms, sizeof(FrameUniforms));
+
+	ring.flush();
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, ring.getBuffer(), offset, sizeof(FrameUniforms));
+	return true;
+}
+
+/*
+* Write one view per camera position looking at the target into the ring buffer and bind it to the view SSBO
+* The views are filled in the frame arena and copied whole into the write only mapping, returns false if the ring region is full
+*/
+static bool WriteViews(GpuRingBuffer& ring, FrameArena& arena, const glm::mat4& projection, const glm::vec3* positions, GLuint viewCount)
+{
+	GLintptr offset = 0;
+	void* destination = ring.allocate(viewCount * sizeof(ViewUniforms), offset);
+	if (!destination)
+		return false;
+
+	ViewUniforms* views = arena.allocate<ViewUniforms>(viewCount);
+	for (GLuint i = 0; i < viewCount; i++)
+	{
+		views[i].viewProjection = projection * glm::lookAt(positions[i], getTarget(), worldUp);
+		views[i].viewPos = glm::vec4(positions[i], 1.0f);
+		ExtractFrustumPlanes(views[i].viewProjection, views[i].frustumPlanes);
+	}
+	memcpy(destination, views, viewCount * sizeof(ViewUniforms));
+
+	ring.flush();
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, VIEW_STORAGE_BINDING, ring.getBuffer(), offset, viewCount * sizeof(ViewUniforms));
+	return true;
+}
+
+// Cull the instances against each bound view and write one draw command per instance and view
+static void CullScene(const SceneResources& scene, GLuint viewCount)
+{
+	glUseProgram(scene.cullProgram);
+	glUniform1ui(glGetUniformLocation(scene.cullProgram, "instanceTotal"), scene.instanceCount);
+	glUniform1ui(glGetUniformLocation(scene.cullProgram, "viewCount"), viewCount);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, scene.instanceSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, scene.lodSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, scene.commandBuffer);
+	glDispatchCompute((scene.instanceCount * viewCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	// Draw commands must be written before they are read as indirect arguments
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+// Submit the culled draw commands with one multi draw per material, the program and VAO must already be bound
+static void DrawScene(const SceneResources& scene, GLuint viewCount)
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, scene.commandBuffer);
+	for (GLuint material = 0; material < MATERIAL_COUNT; material++)
+	{
+		if (scene.materialCount[material] == 0)
+			continue;
+
+		glBindTexture(GL_TEXTURE_2D, scene.materialTextures[material]);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_BYTE,
+			(GLvoid*)(scene.materialFirst[material] * viewCount * sizeof(DrawElementsIndirectCommand)), scene.materialCount[material] * viewCount, 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+// Create color and depth texture arrays with one layer per view and a layered framebuffer to render into them
+static bool CreateMultiViewTarget(MultiViewTarget& target, GLsizei width, GLsizei height, GLuint layers)
+{
+	target.width = width;
+	target.height = height;
+	target.layers = layers;
+
+	glGenTextures(1, &target.colorArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, target.colorArray);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, width, height, layers);
+
+	glGenTextures(1, &target.depthArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, target.depthArray);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, width, height, layers);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// Attaching the whole array makes the framebuffer layered, gl_Layer selects the layer written
+	glGenFramebuffers(1, &target.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target.colorArray, 0);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target.depthArray, 0);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// Single layer framebuffer used to read the views back
+	glGenFramebuffers(1, &target.readFramebuffer);
+
+	return complete;
+}
+
+static void DestroyMultiViewTarget(MultiViewTarget& target)
+{
+	glDeleteFramebuffers(1, &target.framebuffer);
+	glDeleteFramebuffers(1, &target.readFramebuffer);
+	glDeleteTextures(1, &target.colorArray);
+	glDeleteTextures(1, &target.depthArray);
+}
+
+/*
+* Render every camera position into its own layer of the target with a single cull and scene traversal
+* Each instance has one draw command per view, culled and given a level of detail for that view alone so a frame
+* does not depend on the views sharing its pass, the command index read at baseInstance encodes instance and view
+* and the geometry shader routes each triangle to the view's layer
+* Returns false without drawing if the frame data does not fit in the ring region
+*/
+static bool RenderMultiView(const SceneResources& scene, const MultiViewTarget& target, GpuRingBuffer& ring, FrameArena& arena,
+	const glm::mat4& projection, const glm::vec3* positions, GLuint viewCount)
+{
+	FrameUniforms frameUniforms;
+	if (!WriteFrameUniforms(ring, glm::lookAt(positions[0], getTarget(), worldUp), projection, positions[0], frameUniforms)
+		|| !WriteViews(ring, arena, projection, positions, viewCount))
+		return false;
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.framebuffer);
+	glViewport(0, 0, target.width, target.height);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	CullScene(scene, viewCount);
+
+	glUseProgram(scene.multiViewProgram);
+	glUniform1ui(glGetUniformLocation(scene.multiViewProgram, "viewCount"), viewCount);
+	glBindVertexArray(scene.indirectVAO);
+	DrawScene(scene, viewCount);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	return true;
+}
+
+// Read one layer of the target back as top to bottom RGB rows
+static void ReadMultiViewLayer(const MultiViewTarget& target, GLuint layer, unsigned char* pixels)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, target.readFramebuffer);
+	glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target.colorArray, 0, layer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, target.width, target.height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	// OpenGL rows start at the bottom of the image
+	size_t rowSize = target.width * 3;
+	for (GLsizei row = 0; row < target.height / 2; row++)
+		swap_ranges(pixels + row * rowSize, pixels + (row + 1) * rowSize, pixels + (target.height - 1 - row) * rowSize);
+}
+
+// Camera position of a frame in a sequence that orbits the target once
+static glm::vec3 SequencePosition(GLuint frame, GLuint frameTotal)
+{
+	return orbitPosition(2.0f * (GLfloat)PI * frame / frameTotal);
+}
+
+// Render viewCount angles around the target in passes of up to MAX_VIEWS views and save each view as a PNG, the arena is reset per pass
+static bool RenderTurntable(const SceneResources& scene, GpuRingBuffer& ring, FrameArena& arena, GLuint viewCount,
+	GLsizei width, GLsizei height, const string& outputPrefix)
+{
+	MultiViewTarget target;
+	if (!CreateMultiViewTarget(target, width, height, min(viewCount, MAX_VIEWS)))
+	{
+		cout << "Error! Multi-view framebuffer is incomplete" << endl;
+		DestroyMultiViewTarget(target);
+		return false;
+	}
+
+	glm::mat4 projection = glm::perspective(fov, (GLfloat)width / (GLfloat)height, 0.1f, 100.0f);
+	vector<glm::vec3> positions(viewCount);
+	for (GLuint i = 0; i < viewCount; i++)
+		positions[i] = SequencePosition(i, viewCount);
+
+	vector<unsigned char> pixels(width * height * 3);
+	bool saved = true;
+	for (GLuint first = 0; first < viewCount; first += MAX_VIEWS)
+	{
+		GLuint count = min(MAX_VIEWS, viewCount - first);
+
+		arena.reset();
+		ring.beginFrame();
+		bool rendered = RenderMultiView(scene, target, ring, arena, projection, &positions[first], count);
+		ring.endFrame();
+		if (!rendered)
+		{
+			cout << "Error! Ring buffer region is too small for " << count << " views" << endl;
+			saved = false;
+			break;
+		}
+
+		for (GLuint layer = 0; layer < count; layer++)
+		{
+			char fileName[512];
+			snprintf(fileName, sizeof(fileName), "%s_%03u.png", outputPrefix.c_str(), first + layer);
+
+			ReadMultiViewLayer(target, layer, pixels.data());
+			if (!SOIL_save_image(fileName, SOIL_SAVE_TYPE_PNG, width, height, 3, pixels.data()))
+			{
+				cout << "Error! Could not save " << fileName << endl;
+				saved = false;
+			}
+		}
+	}
+
+	DestroyMultiViewTarget(target);
+	return saved;
+}
+
+#ifndef _WIN32
+
+// Keep a descriptor from being inherited by spawned workers
+static void SetCloseOnExec(int fd)
+{
+	fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+static void SetNonBlocking(int fd)
+{
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// Write every byte, a non-blocking descriptor that stays full for a second counts as failed
+static bool SendAll(int fd, const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0)
+	{
+		ssize_t sent = write(fd, bytes, size);
+		if (sent < 0 && errno == EINTR)
+			continue;
+		if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			pollfd writable = { fd, POLLOUT, 0 };
+			if (poll(&writable, 1, 1000) <= 0)
+				return false;
+			continue;
+		}
+		if (sent <= 0)
+			return false;
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+static bool ReceiveAll(int fd, void* data, size_t size)
+{
+	char* bytes = (char*)data;
+	while (size > 0)
+	{
+		ssize_t received = read(fd, bytes, size);
+		if (received < 0 && errno == EINTR)
+			continue;
+		if (received <= 0)
+			return false;
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+// Read what a non-blocking descriptor has available until size bytes have arrived, returns false once the connection is closed
+static bool ReceiveAvailable(int fd, unsigned char* data, size_t size, size_t& received)
+{
+	while (received < size)
+	{
+		ssize_t count = read(fd, data + received, size - received);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return true;
+		if (count <= 0)
+			return false;
+		received += count;
+	}
+	return true;
+}
+
+// Split host:port, an empty host means the local machine
+static bool SplitAddress(const string& address, string& host, string& port)
+{
+	size_t colon = address.rfind(':');
+	if (colon == string::npos)
+		return false;
+
+	host = address.substr(0, colon);
+	port = address.substr(colon + 1);
+	if (host.empty())
+		host = "127.0.0.1";
+	return true;
+}
+
+// Whether a connected socket's peer is on this machine, only then can a pid it reports be one of our processes
+static bool IsLoopbackPeer(int fd)
+{
+	sockaddr_storage peer;
+	socklen_t peerSize = sizeof(peer);
+	if (getpeername(fd, (sockaddr*)&peer, &peerSize) != 0)
+		return false;
+
+	if (peer.ss_family == AF_INET)
+		return (ntohl(((sockaddr_in*)&peer)->sin_addr.s_addr) >> 24) == 127;
+	if (peer.ss_family == AF_INET6)
+	{
+		const in6_addr& address = ((sockaddr_in6*)&peer)->sin6_addr;
+		return IN6_IS_ADDR_LOOPBACK(&address) || (IN6_IS_ADDR_V4MAPPED(&address) && address.s6_addr[12] == 127);
+	}
+	return false;
+}
+
+static int ConnectToCoordinator(const string& address)
+{
+	string host, port;
+	if (!SplitAddress(address, host, port))
+		return -1;
+
+	addrinfo hints = addrinfo();
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* result = nullptr;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0)
+		return -1;
+
+	int fd = -1;
+	for (addrinfo* info = result; info && fd < 0; info = info->ai_next)
+	{
+		fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+		if (fd >= 0 && connect(fd, info->ai_addr, info->ai_addrlen) != 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(result);
+	return fd;
+}
+
+// Listen for workers on host:port, port 0 picks a free port which is returned in boundPort
+static int ListenForWorkers(const string& address, int& boundPort)
+{
+	string host, port;
+	if (!SplitAddress(address, host, port))
+		return -1;
+
+	addrinfo hints = addrinfo();
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	addrinfo* result = nullptr;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0)
+		return -1;
+
+	int fd = -1;
+	for (addrinfo* info = result; info && fd < 0; info = info->ai_next)
+	{
+		fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+		if (fd < 0)
+			continue;
+
+		int reuse = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		if (bind(fd, info->ai_addr, info->ai_addrlen) != 0 || listen(fd, SOMAXCONN) != 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(result);
+	if (fd < 0)
+		return -1;
+
+	sockaddr_storage bound;
+	socklen_t boundSize = sizeof(bound);
+	getsockname(fd, (sockaddr*)&bound, &boundSize);
+	if (bound.ss_family == AF_INET6)
+		boundPort = ntohs(((sockaddr_in6*)&bound)->sin6_port);
+	else
+		boundPort = ntohs(((sockaddr_in*)&bound)->sin_port);
+
+	SetCloseOnExec(fd);
+	return fd;
+}
+
+// Start a worker process of this renderer with its transport option
+static pid_t SpawnWorker(const SequenceOptions& options, const string& transportArg, const string& transportValue)
+{
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		execl("/proc/self/exe", options.executable.c_str(), transportArg.c_str(), transportValue.c_str(), (char*)nullptr);
+		execlp(options.executable.c_str(), options.executable.c_str(), transportArg.c_str(), transportValue.c_str(), (char*)nullptr);
+		_exit(127);
+	}
+	return pid;
+}
+
+/*
+* Render frameTotal frames of the orbit across worker processes and write them in order to one PPM stream
+* Local workers talk over a socket pair, with the tcp transport workers connect to the coordinator's listening
+* socket, local workers over loopback stand in for other nodes which run this renderer with --worker-connect
+* Worker sockets are non-blocking and every busy worker has a deadline that moves with each chunk it sends,
+* a range held by a worker that dies or stalls past its deadline is handed out again, up to retries times,
+* and dead or stalled local workers are replaced, tcp workers report their pid so stand-ins can be killed as well
+*/
+static int RunSequenceCoordinator(const SequenceOptions& options)
+{
+	typedef chrono::steady_clock Clock;
+
+	struct Worker
+	{
+		int fd;
+		pid_t pid; // Local workers, including tcp stand-ins, other nodes are -1
+		bool busy;
+		FrameRequest request;
+		GLuint framesReceived;
+		vector<unsigned char> message; // Header and pixels of the frame being received
+		size_t received;
+		Clock::time_point deadline;
+	};
+
+	// A worker dying mid write must not kill the coordinator
+	signal(SIGPIPE, SIG_IGN);
+
+	FILE* output = fopen(options.outputPath.c_str(), "wb");
+	if (!output)
+	{
+		cout << "Error! Could not open " << options.outputPath << endl;
+		return -1;
+	}
+
+	SequenceConfig config;
+	config.frameTotal = options.frameTotal;
+	config.width = options.width;
+	config.height = options.height;
+	config.packedVertices = options.packedVertices ? 1 : 0;
+	config.batch = options.batch;
+
+	int listenFd = -1;
+	string workerAddress;
+	if (options.tcp)
+	{
+		int port = 0;
+		listenFd = ListenForWorkers(options.listenAddress, port);
+		if (listenFd < 0)
+		{
+			cout << "Error! Could not listen on " << options.listenAddress << endl;
+			fclose(output);
+			return -1;
+		}
+
+		string host, unusedPort;
+		SplitAddress(options.listenAddress, host, unusedPort);
+		if (host == "0.0.0.0" || host == "::")
+			host = "127.0.0.1";
+		workerAddress = host + ":" + to_string(port);
+		cout << "Waiting for workers on port " << port << endl;
+	}
+
+	size_t frameSize = (size_t)options.width * options.height * 3;
+	chrono::seconds timeout(options.timeout);
+	vector<Worker> workers;
+	vector<pid_t> localPids;
+	GLuint respawnsLeft = options.retries * options.workers;
+	Clock::time_point idleSince = Clock::now();
+
+	// Send the sequence settings and start tracking a connected worker
+	auto addWorker = [&](int fd, pid_t pid)
+	{
+		SetNonBlocking(fd);
+		if (!SendAll(fd, &config, sizeof(config)))
+		{
+			close(fd);
+			return;
+		}
+
+		Worker worker;
+		worker.fd = fd;
+		worker.pid = pid;
+		worker.busy = false;
+		worker.request = FrameRequest();
+		worker.framesReceived = 0;
+		worker.message.resize(sizeof(FrameHeader) + frameSize);
+		worker.received = 0;
+		workers.push_back(worker);
+	};
+
+	auto spawnLocalWorker = [&]()
+	{
+		idleSince = Clock::now();
+		if (options.tcp)
+		{
+			pid_t pid = SpawnWorker(options, "--worker-connect", workerAddress);
+			if (pid > 0)
+				localPids.push_back(pid);
+			return;
+		}
+
+		int fds[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+			return;
+		SetCloseOnExec(fds[0]);
+
+		pid_t pid = SpawnWorker(options, "--worker-fd", to_string(fds[1]));
+		close(fds[1]);
+		if (pid <= 0)
+		{
+			close(fds[0]);
+			return;
+		}
+
+		localPids.push_back(pid);
+		addWorker(fds[0], pid);
+	};
+
+	for (GLuint i = 0; i < options.workers; i++)
+		spawnLocalWorker();
+
+	// Split the sequence into ranges that each fit in one multi-view pass
+	deque<FrameRequest> pending;
+	for (GLuint first = 0; first < options.frameTotal; first += options.batch)
+	{
+		FrameRequest request = { first, min(options.batch, options.frameTotal - first) };
+		pending.push_back(request);
+	}
+
+	map<GLuint, GLuint> failures;
+	map<GLuint, vector<unsigned char> > finished;
+	GLuint nextFrame = 0, retried = 0;
+	bool failed = false;
+
+	// Close a worker and hand its range out again, a stalled local worker is killed so it can be replaced
+	auto dropWorker = [&](size_t index)
+	{
+		Worker& worker = workers[index];
+		close(worker.fd);
+		if (worker.pid > 0)
+			kill(worker.pid, SIGKILL);
+		if (worker.busy)
+		{
+			retried++;
+			if (++failures[worker.request.firstFrame] > options.retries)
+			{
+				cout << "Error! Frames " << worker.request.firstFrame << " to " << worker.request.firstFrame + worker.request.count - 1
+					<< " failed " << failures[worker.request.firstFrame] << " times" << endl;
+				failed = true;
+			}
+			pending.push_front(worker.request);
+		}
+		workers.erase(workers.begin() + index);
+	};
+
+	// Read whatever the worker has sent, keeping complete frames that have not been written yet
+	auto receiveFrames = [&](Worker& worker)
+	{
+		// Nothing is expected from an idle worker
+		if (!worker.busy)
+			return false;
+
+		while (worker.busy)
+		{
+			size_t before = worker.received;
+			if (!ReceiveAvailable(worker.fd, worker.message.data(), worker.message.size(), worker.received))
+				return false;
+			if (worker.received > before)
+				worker.deadline = Clock::now() + timeout;
+			if (worker.received < worker.message.size())
+				return true;
+
+			FrameHeader header;
+			memcpy(&header, worker.message.data(), sizeof(header));
+			if (header.frame != worker.request.firstFrame + worker.framesReceived
+				|| header.width != (uint32_t)options.width || header.height != (uint32_t)options.height)
+				return false;
+
+			if (header.frame >= nextFrame)
+				finished[header.frame].assign(worker.message.begin() + sizeof(FrameHeader), worker.message.end());
+			worker.received = 0;
+			worker.busy = ++worker.framesReceived < worker.request.count;
+		}
+		return true;
+	};
+
+	while (nextFrame < options.frameTotal && !failed)
+	{
+		// Reap exited local workers and replace them while frames are left
+		int status = 0;
+		pid_t exited;
+		while ((exited = waitpid(-1, &status, WNOHANG)) > 0)
+			localPids.erase(remove(localPids.begin(), localPids.end(), exited), localPids.end());
+		while (localPids.size() < options.workers && respawnsLeft > 0)
+		{
+			respawnsLeft--;
+			spawnLocalWorker();
+		}
+
+		if (workers.empty() && localPids.empty() && options.workers > 0)
+		{
+			cout << "Error! No workers left" << endl;
+			failed = true;
+			break;
+		}
+
+		// Give up if no worker has been connected for a whole timeout
+		if (!workers.empty())
+			idleSince = Clock::now();
+		else if (Clock::now() - idleSince > timeout)
+		{
+			cout << "Error! No worker connected for " << options.timeout << " seconds" << endl;
+			failed = true;
+			break;
+		}
+
+		// Hand out ranges to idle workers
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			if (workers[i].busy || pending.empty())
+				continue;
+
+			workers[i].request = pending.front();
+			pending.pop_front();
+			if (SendAll(workers[i].fd, &workers[i].request, sizeof(FrameRequest)))
+			{
+				workers[i].busy = true;
+				workers[i].framesReceived = 0;
+				workers[i].received = 0;
+				workers[i].deadline = Clock::now() + timeout;
+			}
+			else
+				pending.push_front(workers[i].request);
+		}
+
+		vector<pollfd> polled;
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			pollfd entry = { workers[i].fd, POLLIN, 0 };
+			polled.push_back(entry);
+		}
+		if (listenFd >= 0)
+		{
+			pollfd entry = { listenFd, POLLIN, 0 };
+			polled.push_back(entry);
+		}
+
+		if (poll(polled.data(), polled.size(), 100) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			failed = true;
+			break;
+		}
+
+		// Collect frames, a worker that closes its connection, sends bad data or stalls past its deadline is dropped
+		Clock::time_point now = Clock::now();
+		for (size_t i = workers.size(); i-- > 0;)
+		{
+			if (polled[i].revents & (POLLIN | POLLHUP | POLLERR))
+			{
+				if (!receiveFrames(workers[i]))
+				{
+					dropWorker(i);
+					continue;
+				}
+			}
+
+			if (workers[i].busy && now > workers[i].deadline)
+			{
+				cout << "Worker timed out on frames " << workers[i].request.firstFrame << " to "
+					<< workers[i].request.firstFrame + workers[i].request.count - 1 << endl;
+				dropWorker(i);
+			}
+		}
+
+		// Workers connecting over tcp, local stand-ins or other nodes, the pid is kept only for our own stand-ins
+		if (listenFd >= 0 && (polled.back().revents & POLLIN))
+		{
+			int fd = accept(listenFd, nullptr, nullptr);
+			if (fd >= 0)
+			{
+				SetCloseOnExec(fd);
+				WorkerHello hello;
+				pollfd readable = { fd, POLLIN, 0 };
+				if (poll(&readable, 1, 1000) > 0 && ReceiveAll(fd, &hello, sizeof(hello)))
+				{
+					pid_t pid = (pid_t)hello.pid;
+					bool local = IsLoopbackPeer(fd) && find(localPids.begin(), localPids.end(), pid) != localPids.end();
+					addWorker(fd, local ? pid : -1);
+				}
+				else
+					close(fd);
+			}
+		}
+
+		// Write frames in order as soon as the next one is available, a full disk or closed pipe ends the run
+		for (auto frame = finished.find(nextFrame); frame != finished.end() && !failed; frame = finished.find(nextFrame))
+		{
+			if (fprintf(output, "P6\n%d %d\n255\n", options.width, options.height) < 0
+				|| fwrite(frame->second.data(), 1, frame->second.size(), output) != frame->second.size())
+			{
+				cout << "Error! Could not write " << options.outputPath << endl;
+				failed = true;
+			}
+			finished.erase(frame);
+			nextFrame++;
+		}
+	}
+
+	// Tell the workers to exit and give the local processes a timeout to do so
+	FrameRequest stop = { 0, 0 };
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		SendAll(workers[i].fd, &stop, sizeof(stop));
+		close(workers[i].fd);
+	}
+	if (listenFd >= 0)
+		close(listenFd);
+
+	Clock::time_point exitDeadline = Clock::now() + timeout;
+	for (size_t i = 0; i < localPids.size(); i++)
+	{
+		if (failed)
+			kill(localPids[i], SIGTERM);
+
+		int status = 0;
+		while (waitpid(localPids[i], &status, WNOHANG) == 0)
+		{
+			if (Clock::now() > exitDeadline)
+			{
+				kill(localPids[i], SIGKILL);
+				waitpid(localPids[i], &status, 0);
+				break;
+			}
+			this_thread::sleep_for(chrono::milliseconds(10));
+		}
+	}
+
+	// Buffered frames are only known to be written once the stream is flushed and closed
+	bool writeFailed = ferror(output) != 0;
+	if (fclose(output) != 0 || writeFailed)
+	{
+		if (!failed)
+			cout << "Error! Could not write " << options.outputPath << endl;
+		failed = true;
+	}
+	if (failed)
+		return -1;
+
+	cout << "Rendered " << options.frameTotal << " frames to " << options.outputPath << " with " << retried << " retried ranges" << endl;
+	return 0;
+}
+
+// Connect to the coordinator and receive the sequence settings, done before the context is created since they select the vertex format
+static int ConnectSequenceWorker(const SequenceOptions& options, SequenceConfig& config)
+{
+	int fd = options.workerFd >= 0 ? options.workerFd : ConnectToCoordinator(options.connectAddress);
+	if (fd < 0)
+	{
+		cout << "Error! Could not connect to " << options.connectAddress << endl;
+		return -1;
+	}
+
+	WorkerHello hello = { (uint32_t)getpid() };
+	if ((options.workerFd < 0 && !SendAll(fd, &hello, sizeof(hello))) || !ReceiveAll(fd, &config, sizeof(config)) || config.frameTotal == 0 || config.width == 0 || config.height == 0
+		|| config.width > (uint32_t)MAX_OUTPUT_SIZE || config.height > (uint32_t)MAX_OUTPUT_SIZE || config.batch == 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// Render the frame ranges requested by the coordinator and send the frames back in order, each range's transient data comes from the arena
+static int RunSequenceWorker(const SceneResources& scene, GpuRingBuffer& ring, FrameArena& arena, int fd, const SequenceConfig& config)
+{
+	// Only as many layers as the coordinator's batch, MAX_VIEWS layers at 1080p take about a gigabyte
+	MultiViewTarget target;
+	if (!CreateMultiViewTarget(target, config.width, config.height, min((GLuint)config.batch, MAX_VIEWS)))
+	{
+		DestroyMultiViewTarget(target);
+		close(fd);
+		return -1;
+	}
+
+	glm::mat4 projection = glm::perspective(fov, (GLfloat)config.width / (GLfloat)config.height, 0.1f, 100.0f);
+	vector<unsigned char> pixels(config.width * config.height * 3);
+
+	bool connected = true;
+	FrameRequest request;
+	while (connected && ReceiveAll(fd, &request, sizeof(request)) && request.count > 0)
+	{
+		GLuint count = min((GLuint)request.count, target.layers);
+		arena.reset();
+		glm::vec3* positions = arena.allocate<glm::vec3>(count);
+		for (GLuint i = 0; i < count; i++)
+			positions[i] = SequencePosition(request.firstFrame + i, config.frameTotal);
+
+		ring.beginFrame();
+		bool rendered = RenderMultiView(scene, target, ring, arena, projection, positions, count);
+		ring.endFrame();
+		if (!rendered)
+		{
+			cout << "Error! Ring buffer region is too small for " << count << " views" << endl;
+			connected = false;
+			break;
+		}
+
+		for (GLuint layer = 0; layer < count && connected; layer++)
+		{
+			FrameHeader header = { request.firstFrame + layer, config.width, config.height };
+			ReadMultiViewLayer(target, layer, pixels.data());
+			connected = SendAll(fd, &header, sizeof(header)) && SendAll(fd, pixels.data(), pixels.size());
+		}
+	}
+
+	DestroyMultiViewTarget(target);
+	close(fd);
+	return connected ? 0 : -1;
+}
+
+#else
+
+static int RunSequenceCoordinator(const SequenceOptions& options)
+{
+	cout << "Error! Sequence rendering with worker processes is only available on POSIX systems" << endl;
+	return -1;
+}
 
+static int ConnectSequenceWorker(const SequenceOptions& options, SequenceConfig& config)
+{
+	cout << "Error! Sequence rendering with worker processes is only available on POSIX systems" << endl;
+	return -1;
+}
 
+static int RunSequenceWorker(const SceneResources& scene, GpuRingBuffer& ring, FrameArena& arena, int fd, const SequenceConfig& config)
+{
+	return -1;
 }
 
+#endif
+
 // Create and Compile Shaders
 static GLuint CompileShader(const string& source, GLuint shaderType)
 {
@@ -94,8 +1564,8 @@ static GLuint CompileShader(const string& source, GLuint shaderType)
 
 }
 
-// Create Program Object
-static GLuint CreateShaderProgram(const string& vertexShader, const string& fragmentShader)
+// Create Program Object, the geometry shader is optional
+static GLuint CreateShaderProgram(const string& vertexShader, const string& fragmentShader, const string& geometryShader = "")
 {
 	// Compile vertex shader
 	GLuint vertexShaderComp = CompileShader(vertexShader, GL_VERTEX_SHADER);
@@ -110,34 +1580,246 @@ static GLuint CreateShaderProgram(const string& vertexShader, const string& frag
 	glAttachShader(shaderProgram, vertexShaderComp);
 	glAttachShader(shaderProgram, fragmentShaderComp);
 
+	// Compile and attach geometry shader
+	GLuint geometryShaderComp = 0;
+	if (!geometryShader.empty())
+	{
+		geometryShaderComp = CompileShader(geometryShader, GL_GEOMETRY_SHADER);
+		glAttachShader(shaderProgram, geometryShaderComp);
+	}
+
 	// Link shaders to create executable
 	glLinkProgram(shaderProgram);
 
 	// Delete compiled vertex and fragment shaders
 	glDeleteShader(vertexShaderComp);
 	glDeleteShader(fragmentShaderComp);
+	if (geometryShaderComp)
+		glDeleteShader(geometryShaderComp);
 
 	// Return Shader Program
 	return shaderProgram;
 
 }
 
+// Create Compute Program Object, returns 0 if the shader fails to link
+static GLuint CreateComputeProgram(const string& computeShader)
+{
+	GLuint computeShaderComp = CompileShader(computeShader, GL_COMPUTE_SHADER);
+
+	GLuint computeProgram = glCreateProgram();
+	glAttachShader(computeProgram, computeShaderComp);
+	glLinkProgram(computeProgram);
+	glDeleteShader(computeShaderComp);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(computeProgram, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		glDeleteProgram(computeProgram);
+		return 0;
+	}
+
+	return computeProgram;
+}
+
+// Parse a command line count within [minimum, maximum], prints an error naming the option if the value is not a whole number in range
+template<typename T>
+static bool ParseCount(const string& option, const char* text, long minimum, long maximum, T& value)
+{
+	char* end = nullptr;
+	errno = 0;
+	long parsed = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || errno == ERANGE || parsed < minimum || parsed > maximum)
+	{
+		cout << "Error! " << option << " expects a whole number from " << minimum << " to " << maximum << ", got " << text << endl;
+		return false;
+	}
+
+	value = (T)parsed;
+	return true;
+}
+
+// Parse an output size given as WxH
+static bool ParseSize(const char* text, GLsizei& width, GLsizei& height)
+{
+	int parsedWidth = 0, parsedHeight = 0;
+	char trailing;
+	if (sscanf(text, "%dx%d%c", &parsedWidth, &parsedHeight, &trailing) != 2
+		|| parsedWidth < 1 || parsedHeight < 1 || parsedWidth > MAX_OUTPUT_SIZE || parsedHeight > MAX_OUTPUT_SIZE)
+	{
+		cout << "Error! --size expects WxH with sides from 1 to " << MAX_OUTPUT_SIZE << ", got " << text << endl;
+		return false;
+	}
+
+	width = parsedWidth;
+	height = parsedHeight;
+	return true;
+}
+
 /*
 * Main function to create window where keycallbacks are used to interact with the camera around the objects drawn
 */
-int main(void)
+int main(int argc, char* argv[])
 {
 	//Demensions for window
 	width = 640; height = 480;
 	GLFWwindow* window;
+
+	// Turntable options, --turntable N renders N views around the chair into PNG files instead of opening the interactive window
+	GLuint turntableViews = 0;
+	GLsizei outputWidth = 256, outputHeight = 256;
+	string outputPrefix = "turntable";
+
+	// Sequence options, --render-sequence N renders N frames of the orbit across worker processes into one PPM stream
+	SequenceOptions sequence;
+	sequence.frameTotal = 0;
+	sequence.workers = min(max(thread::hardware_concurrency(), 1u), MAX_SEQUENCE_WORKERS);
+	sequence.batch = 8;
+	sequence.retries = 3;
+	sequence.timeout = 30;
+	sequence.tcp = false;
+	sequence.listenAddress = "127.0.0.1:0";
+	sequence.executable = argv[0];
+	sequence.workerFd = -1;
+
+	// Vertex format of the plane, --vertex-format float keeps the unpacked 32 byte vertices
+	bool packedVertices = true;
+
+	// Every invalid option is reported before any work is done, all options take a value
+	const string options[] = { "--turntable", "--size", "--output", "--render-sequence", "--workers", "--batch", "--retries",
+		"--timeout", "--transport", "--listen", "--worker-fd", "--worker-connect", "--vertex-format" };
+	bool validArguments = true;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (find(begin(options), end(options), arg) == end(options))
+		{
+			cout << "Error! Unknown option " << arg << endl;
+			validArguments = false;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			cout << "Error! " << arg << " expects a value" << endl;
+			validArguments = false;
+			break;
+		}
+
+		if (arg == "--turntable")
+			validArguments &= ParseCount(arg, argv[++i], 1, MAX_TURNTABLE_VIEWS, turntableViews);
+		else if (arg == "--size")
+			validArguments &= ParseSize(argv[++i], outputWidth, outputHeight);
+		else if (arg == "--output")
+			outputPrefix = argv[++i];
+		else if (arg == "--render-sequence")
+			validArguments &= ParseCount(arg, argv[++i], 1, MAX_SEQUENCE_FRAMES, sequence.frameTotal);
+		else if (arg == "--workers")
+			validArguments &= ParseCount(arg, argv[++i], 0, MAX_SEQUENCE_WORKERS, sequence.workers);
+		else if (arg == "--batch")
+			validArguments &= ParseCount(arg, argv[++i], 1, MAX_VIEWS, sequence.batch);
+		else if (arg == "--retries")
+			validArguments &= ParseCount(arg, argv[++i], 0, MAX_SEQUENCE_RETRIES, sequence.retries);
+		else if (arg == "--timeout")
+			validArguments &= ParseCount(arg, argv[++i], 1, MAX_SEQUENCE_TIMEOUT, sequence.timeout);
+		else if (arg == "--transport")
+		{
+			string transport = argv[++i];
+			sequence.tcp = transport == "tcp";
+			if (transport != "tcp" && transport != "local")
+			{
+				cout << "Error! --transport expects local or tcp, got " << transport << endl;
+				validArguments = false;
+			}
+		}
+		else if (arg == "--listen")
+			sequence.listenAddress = argv[++i];
+		else if (arg == "--worker-fd")
+			validArguments &= ParseCount(arg, argv[++i], 0, INT_MAX, sequence.workerFd);
+		else if (arg == "--worker-connect")
+			sequence.connectAddress = argv[++i];
+		else if (arg == "--vertex-format")
+		{
+			string format = argv[++i];
+			packedVertices = format == PACKED_VERTEX_FORMAT.name;
+			if (format != PACKED_VERTEX_FORMAT.name && format != FLOAT_VERTEX_FORMAT.name)
+			{
+				cout << "Error! --vertex-format expects packed or float, got " << format << endl;
+				validArguments = false;
+			}
+		}
+	}
+
+	// Without local workers only other nodes connecting over tcp can render a sequence
+	if (sequence.frameTotal > 0 && sequence.workers == 0 && !sequence.tcp)
+	{
+		cout << "Error! --workers 0 needs --transport tcp" << endl;
+		validArguments = false;
+	}
+	if (!validArguments)
+		return -1;
+
+	sequence.width = outputWidth;
+	sequence.height = outputHeight;
+	sequence.outputPath = outputPrefix + ".ppm";
+	sequence.packedVertices = packedVertices;
+
+	// The coordinator only hands out work, rendering happens in the worker processes
+	if (sequence.frameTotal > 0)
+		return RunSequenceCoordinator(sequence);
+
+	bool sequenceWorker = sequence.workerFd >= 0 || !sequence.connectAddress.empty();
+	bool offscreen = turntableViews > 0 || sequenceWorker;
+
+	// Workers take the frame size and vertex format from the coordinator, so every node renders the same frames
+	int workerFd = -1;
+	SequenceConfig workerConfig = SequenceConfig();
+	if (sequenceWorker)
+	{
+		workerFd = ConnectSequenceWorker(sequence, workerConfig);
+		if (workerFd < 0)
+			return -1;
+		packedVertices = workerConfig.packedVertices != 0;
+	}
 	
+	// Offscreen runs on a render node without a display use GLFW's null platform with a surfaceless EGL context
+	bool headless = false;
+#if defined(__linux__) && defined(GLFW_PLATFORM_NULL)
+	headless = offscreen && !getenv("DISPLAY") && !getenv("WAYLAND_DISPLAY");
+	if (headless)
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+
 	if (!glfwInit())
+	{
+		if (offscreen)
+			cout << "Error! Could not initialize GLFW, offscreen rendering without a display needs GLFW 3.4 and EGL" << endl;
 		return -1;
+	}
+
+	/* Create a windowed mode window and its OpenGL context, request a 4.3 core profile for GPU-driven rendering */
+	/* Mesa only provides 4.3 as a core profile, then try 4.3 in any profile and finally the default context */
+	window = NULL;
+	for (int attempt = 0; attempt < 3 && !window; attempt++)
+	{
+		glfwDefaultWindowHints();
+		if (attempt < 2)
+		{
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		}
+		if (attempt == 0)
+			glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, offscreen ? GLFW_FALSE : GLFW_TRUE);
+		if (headless)
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+		window = glfwCreateWindow(width, height, "Main Window", NULL, NULL);
+	}
 
-	/* Create a windowed mode window and its OpenGL context */
-	window = glfwCreateWindow(width, height, "Main Window", NULL, NULL);
 	if (!window)
 	{
+		if (headless)
+			cout << "Error! Could not create a headless EGL context" << endl;
 		glfwTerminate();
 		return -1;
 	}
@@ -151,10 +1833,14 @@ int main(void)
 	/* Make the window's context current */
 	glfwMakeContextCurrent(window);
 
-	// Initialize GLEW
+	// Initialize GLEW, experimental is needed to load every entry point of a core context
+	glewExperimental = GL_TRUE;
 	if (glewInit() != GLEW_OK)
 		cout << "Error!" << endl;
 
+	// Compute shaders, SSBOs and multi draw indirect are core in OpenGL 4.3
+	gpuDrivenSupported = GLEW_VERSION_4_3 ? true : false;
+
 	GLfloat lampVertices[] = {
 		-0.5, -0.5, 0.0, // index 0
 
@@ -172,33 +1858,59 @@ int main(void)
 
 	GLfloat vertices[] = {
 
-		// Triangle charateristics each index location and color used for shader
+		// Triangle charateristics each index location, texture coordinate and normal, encoded into the selected vertex format
 		-0.25, -0.25, 0.0,// index 0
-		1.0, 0.0, 0.0, 
 		0.0, 0.0, 
 		0.0f, 0.0f, 1.0f, 
 
 		-0.25, 0.25, 0.0, // index 1
-		0.0, 1.0, 0.0, 
 		0.0, 1.0, 
 		0.0f, 0.0f, 1.0f, 
 
 		0.25, -0.25, 0.0, // index 2	
-		0.0, 0.0, 1.0, 
 		1.0, 0.0, 
 		0.0f, 0.0f, 1.0f, 
 
 			
 		0.25, 0.25, 0.0,  // index 3	
-		1.0, 0.0, 1.0, 
 		1.0, 1.0, 
+		0.0f, 0.0f, 1.0f, 
+
+		// Edge midpoints and center used by the subdivided level of detail
+		-0.25, 0.0, 0.0,  // index 4
+		0.0, 0.5, 
+		0.0f, 0.0f, 1.0f, 
+
+		0.0, -0.25, 0.0,  // index 5
+		0.5, 0.0, 
+		0.0f, 0.0f, 1.0f, 
+
+		0.0, 0.0, 0.0,    // index 6
+		0.5, 0.5, 
+		0.0f, 0.0f, 1.0f, 
+
+		0.0, 0.25, 0.0,   // index 7
+		0.5, 1.0, 
+		0.0f, 0.0f, 1.0f, 
+
+		0.25, 0.0, 0.0,   // index 8
+		1.0, 0.5, 
 		0.0f, 0.0f, 1.0f 
 	};
 
-	// Define element indices
+	// Define element indices, the single quad first and then the plane split into four quads
 	GLubyte indices[] = {
 		0, 1, 2,
-		1, 2, 3
+		1, 2, 3,
+
+		0, 4, 5,
+		4, 5, 6,
+		4, 1, 6,
+		1, 6, 7,
+		5, 6, 2,
+		6, 2, 8,
+		6, 7, 8,
+		7, 8, 3
 	};
 
 	// Plane Transformations for each plane, front, right, back and left
@@ -266,71 +1978,174 @@ int main(void)
 		0.0f, 90.0f, 180.0f, -90.0f, -90.f, 90.f
 	};
 
-	
+	// Build every plane of the scene once, the scene is static so instances are reused each frame
+	vector<SceneInstance> sceneInstances;
+
+	// Create back right leg for chair
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glm::mat4 modelMatrix;
+		modelMatrix = glm::translate(modelMatrix, planePositions[i]);
+		modelMatrix = glm::rotate(modelMatrix, planeRotations[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
+		modelMatrix = glm::scale(modelMatrix, glm::vec3(0.50f, 5.5f, 0.50f));
+		sceneInstances.push_back(MakeInstance(modelMatrix, MATERIAL_WOOD));
+	}
+
+	// Create back left leg for chair
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glm::mat4 modelMatrix;
+		modelMatrix = glm::translate(modelMatrix, planePositions2[i]);
+		modelMatrix = glm::rotate(modelMatrix, planeRotations[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
+		modelMatrix = glm::scale(modelMatrix, glm::vec3(0.50f, 5.5f, 0.50f));
+		sceneInstances.push_back(MakeInstance(modelMatrix, MATERIAL_WOOD));
+	}
+
+	// Create front left leg of chair
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glm::mat4 modelMatrix;
+		modelMatrix = glm::translate(modelMatrix, planePositions3[i]);
+		modelMatrix = glm::rotate(modelMatrix, planeRotations[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
+		modelMatrix = glm::scale(modelMatrix, glm::vec3(0.50f, 3.0f, 0.50f));
+		sceneInstances.push_back(MakeInstance(modelMatrix, MATERIAL_WOOD));
+	}
+
+	// Create front right leg of chair
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glm::mat4 modelMatrix;
+		modelMatrix = glm::translate(modelMatrix, planePositions4[i]);
+		modelMatrix = glm::rotate(modelMatrix, planeRotations[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
+		modelMatrix = glm::scale(modelMatrix, glm::vec3(0.50f, 3.0f, 0.50f));
+		sceneInstances.push_back(MakeInstance(modelMatrix, MATERIAL_WOOD));
+	}
+
+	// Create chair seat
+	for (GLuint i = 0; i < 6; i++)
+	{
+		glm::mat4 modelMatrix;
+		modelMatrix = glm::translate(modelMatrix, planePositions5[i]);
+		modelMatrix = glm::rotate(modelMatrix, planeRotations3[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
+		modelMatrix = glm::scale(modelMatrix, glm::vec3(2.1f, 0.45f, 2.50f));
+		if (i >= 4)
+			modelMatrix = glm::rotate(modelMatrix, planeRotations3[i] * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
+		sceneInstances.push_back(MakeInstance(modelMatrix, MATERIAL_WOOD));
+	}
+
+	// Chair Back
+	for (GLuint i = 0; i < 3; i++)
+	{
+		glm::mat4 modelMatrix;
+		modelMatrix = glm::translate(modelMatrix, planePositions6[i]);
+		modelMatrix = glm::rotate(modelMatrix, planeRotations2[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
+		modelMatrix = glm::scale(modelMatrix, glm::vec3(2.5f, 1.85f, 1.0f));
+		if (i >= 2) {
+			modelMatrix = glm::rotate(modelMatrix, planeRotations2[i] * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.20f, 2.5f, 1.0f));
+		}
+		sceneInstances.push_back(MakeInstance(modelMatrix, MATERIAL_WOOD));
+	}
+
+	// Create grid textured floor
+	{
+		glm::mat4 modelMatrix;
+		modelMatrix = glm::translate(modelMatrix, glm::vec3(-.4f, -0.75f, 0.1f));
+		modelMatrix = glm::rotate(modelMatrix, 90.f * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
+		modelMatrix = glm::scale(modelMatrix, glm::vec3(5.f, 5.f, 5.f));
+		sceneInstances.push_back(MakeInstance(modelMatrix, MATERIAL_GRID));
+	}
+
+	// Group instances by material so each material is one contiguous range of draw commands
+	stable_sort(sceneInstances.begin(), sceneInstances.end(),
+		[](const SceneInstance& a, const SceneInstance& b) { return a.material < b.material; });
+
+	GLuint materialFirst[MATERIAL_COUNT] = {}, materialCount[MATERIAL_COUNT] = {};
+	for (GLuint i = 0; i < sceneInstances.size(); i++)
+	{
+		GLuint material = sceneInstances[i].material;
+		if (materialCount[material] == 0)
+			materialFirst[material] = i;
+		materialCount[material]++;
+	}
+
+	// Level of detail table, the plane is drawn subdivided close to the camera and as a single quad up to the far plane
+	MeshLod meshLods[] = {
+		{ 24, 6, 3.0f, 0 },
+		{ 6, 0, 100.0f, 0 }
+	};
+
+
 	glEnable(GL_DEPTH_TEST);
 
 
-	// Create VBO and EBO for each 3D object, floor and light source that is processed in the shader
-	GLuint cubeVBO, cubeEBO, cubeVAO, floorVBO, floorEBO, floorVAO, lampVBO, lampEBO, lampVAO;
+	// Encode the plane vertices in the selected format
+	const VertexFormat& vertexFormat = packedVertices ? PACKED_VERTEX_FORMAT : FLOAT_VERTEX_FORMAT;
+	vector<unsigned char> vertexData = EncodeVertices(vertexFormat, vertices, sizeof(vertices) / (vertexFormat.sourceFloats * sizeof(GLfloat)));
 
-	glGenBuffers(1, &cubeVBO); 
-	glGenBuffers(1, &cubeEBO); 
+	// Create VBO and EBO for the plane shared by the 3D objects and floor, and for the light source that is processed in the shader
+	GLuint cubeVBO, cubeEBO, cubeVAO, lampVBO, lampEBO, lampVAO;
 
-	glGenBuffers(1, &floorVBO); 
-	glGenBuffers(1, &floorEBO); 
+	glGenBuffers(1, &cubeVBO);
+	glGenBuffers(1, &cubeEBO);
 
-	glGenBuffers(1, &lampVBO); 
-	glGenBuffers(1, &lampEBO); 
-	
-	glGenVertexArrays(1, &cubeVAO); 
-	glGenVertexArrays(1, &floorVAO); 
-	glGenVertexArrays(1, &lampVAO); 
+	glGenBuffers(1, &lampVBO);
+	glGenBuffers(1, &lampEBO);
+
+	glGenVertexArrays(1, &cubeVAO);
+	glGenVertexArrays(1, &lampVAO);
 
 	glBindVertexArray(cubeVAO);
 
 	// VBO and EBO Placed in User-Defined VAO
 	glBindBuffer(GL_ARRAY_BUFFER, cubeVBO); 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO); 
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW); 
+	glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW); 
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW); 
 	
 	// Specify attribute location and layout to GPU for 3D objects
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
+	SetVertexFormat(vertexFormat);
+	 
+	glBindVertexArray(0); 
 
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(1);
+	// Define VAO for GPU-driven rendering, shares the plane buffers and adds a per command index for up to MAX_VIEWS views of every instance
+	GLuint indirectVAO = 0, instanceIndexVBO = 0, instanceSSBO = 0, lodSSBO = 0, commandBuffer = 0;
+	if (gpuDrivenSupported)
+	{
+		vector<GLuint> instanceIndices(sceneInstances.size() * MAX_VIEWS);
+		for (GLuint i = 0; i < instanceIndices.size(); i++)
+			instanceIndices[i] = i;
 
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(2);
+		glGenVertexArrays(1, &indirectVAO);
+		glGenBuffers(1, &instanceIndexVBO);
+		glBindVertexArray(indirectVAO);
 
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(3);
-	 
-	glBindVertexArray(0); 
+		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
 
-	//Define floor VAO
-	glBindVertexArray(floorVAO);
+		SetVertexFormat(vertexFormat);
 
-	glBindBuffer(GL_ARRAY_BUFFER, floorVBO); 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, floorEBO); 
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW); 
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW); 
+		// Command index is read at baseInstance of each draw command, it is instance * viewCount + view
+		glBindBuffer(GL_ARRAY_BUFFER, instanceIndexVBO);
+		glBufferData(GL_ARRAY_BUFFER, instanceIndices.size() * sizeof(GLuint), instanceIndices.data(), GL_STATIC_DRAW);
+		SetVertexFormat(INSTANCE_INDEX_FORMAT);
 
-	// Specify attribute location and layout to GPU for floor
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
 
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(1);
+		// Instances and levels of detail in SSBOs, the culling shader writes one draw command per instance and view
+		glGenBuffers(1, &instanceSSBO);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceSSBO);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sceneInstances.size() * sizeof(SceneInstance), sceneInstances.data(), GL_STATIC_DRAW);
 
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(2);
+		glGenBuffers(1, &lodSSBO);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lodSSBO);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(meshLods), meshLods, GL_STATIC_DRAW);
 
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(3);
-	
-	glBindVertexArray(0);
+		glGenBuffers(1, &commandBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sceneInstances.size() * MAX_VIEWS * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
 
 	// Define Lamp VAO
 	glBindVertexArray(lampVAO);
@@ -342,8 +2157,7 @@ int main(void)
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(lampIndices), lampIndices, GL_STATIC_DRAW); 
 	
 	// Specify attribute location and layout to GPU for floor
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0 * sizeof(GLfloat), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
+	SetVertexFormat(LAMP_VERTEX_FORMAT);
 
 	glBindVertexArray(0);
 
@@ -371,59 +2185,67 @@ int main(void)
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 
+	// Per-frame uniform block source code, declared the same way in every shader that reads it
+	string frameUniformBlockSource =
+		"layout(std140) uniform FrameData"
+		"{"
+		"mat4 view;"
+		"mat4 projection;"
+		"vec4 viewPos;"
+		"vec4 lightPos;"
+		"vec4 lightColor;"
+		"vec4 objectColor;"
+		"vec4 frustumPlanes[6];"
+		"};";
+
 	// Vertex shader source code
 	string vertexShaderSource =
 		"#version 330 core\n"
 		"layout(location = 0) in vec3 vPosition;"
-		"layout(location = 1) in vec3 aColor;"
 		"layout(location = 2) in vec2 texCoord;"
 		"layout(location = 3) in vec3 normal;"
-		"out vec3 oColor;"
 		"out vec2 oTexCoord;"
 		"out vec3 oNormal;"
 		"out vec3 fragPos;"
+		"out vec3 oViewPos;"
 		"uniform mat4 model;"
-		"uniform mat4 view;"
-		"uniform mat4 projection;"
+		+ frameUniformBlockSource +
 		"void main()\n"
 		"{\n"
 		"gl_Position = projection * view * model * vec4(vPosition.x, vPosition.y, vPosition.z, 1.0);"
-		"oColor = aColor;"
 		"oNormal = mat3(transpose(inverse(model))) * normal;"
 		"fragPos = vec3(model * vec4(vPosition, 1.0f));"
 		"oTexCoord = texCoord;"
+		"oViewPos = viewPos.xyz;"
 		"}\n";
 
 	// Fragment shader source code
 	string fragmentShaderSource =
 		"#version 330 core\n"
-		"in vec3 oColor;"
 		"in vec2 oTexCoord;"
 		"in vec3 oNormal;"
 		"in vec3 fragPos;"
+		"in vec3 oViewPos;"
 		"out vec4 fragColor;"
 		"uniform sampler2D myTexture;"
-		"uniform vec3 objectColor;"
-		"uniform vec3 lightColor;"
-		"uniform vec3 lightPos;"
-		"uniform vec3 viewPos;"
+		+ frameUniformBlockSource +
 		"void main()\n"
 		"{\n"
 		"//Ambient\n"
 		"float ambientStrength = 0.4f;"
-		"vec3 ambient = ambientStrength * lightColor;"
+		"vec3 ambient = ambientStrength * lightColor.rgb;"
 		"//Diffuse\n"
 		"vec3 norm = normalize(oNormal);"
-		"vec3 lightDir = normalize(lightPos - fragPos);"
+		"vec3 lightDir = normalize(lightPos.xyz - fragPos);"
 		"float diff = max(dot(norm, lightDir), 0.0);"
-		"vec3 diffuse = diff * lightColor;"
+		"vec3 diffuse = diff * lightColor.rgb;"
 		"//Specularity\n"
 		"float specularStr = 1.5f;"
-		"vec3 viewDir = normalize(viewPos - fragPos);"
+		"vec3 viewDir = normalize(oViewPos - fragPos);"
 		"vec3 reflectDir = reflect(-lightDir, norm);"
 		"float spec = pow(max(dot(viewDir, reflectDir), 0.0), 128);"
-		"vec3 specular = specularStr * spec * lightColor;"
-		"vec3 result = (ambient + diffuse + specular) * objectColor;"
+		"vec3 specular = specularStr * spec * lightColor.rgb;"
+		"vec3 result = (ambient + diffuse + specular) * objectColor.rgb;"
 		"fragColor = texture(myTexture, oTexCoord) * vec4(result, 1.0f);"
 		"}\n";
 
@@ -452,6 +2274,198 @@ int main(void)
 	GLuint shaderProgram = CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
 	GLuint lampShaderProgram = CreateShaderProgram(lampVertexShaderSource, lampFragmentShaderSource);
 
+	// GPU-driven vertex shader source code, the model matrix is read from the instance SSBO, with a single view the command index is the instance
+	string indirectVertexShaderSource =
+		"#version 430 core\n"
+		"layout(location = 0) in vec3 vPosition;"
+		"layout(location = 2) in vec2 texCoord;"
+		"layout(location = 3) in vec3 normal;"
+		"layout(location = 4) in uint instanceIndex;"
+		"struct Instance { mat4 model; vec4 bounds; uint material; uint lodFirst; uint lodCount; uint padding; };"
+		"layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };"
+		"out vec2 oTexCoord;"
+		"out vec3 oNormal;"
+		"out vec3 fragPos;"
+		"out vec3 oViewPos;"
+		+ frameUniformBlockSource +
+		"void main()\n"
+		"{\n"
+		"mat4 model = instances[instanceIndex].model;"
+		"gl_Position = projection * view * model * vec4(vPosition, 1.0);"
+		"oNormal = mat3(transpose(inverse(model))) * normal;"
+		"fragPos = vec3(model * vec4(vPosition, 1.0f));"
+		"oTexCoord = texCoord;"
+		"oViewPos = viewPos.xyz;"
+		"}\n";
+
+	// Per-view storage block source code, one entry per camera rendered in the pass
+	string viewStorageBlockSource =
+		"struct View { mat4 viewProjection; vec4 viewPos; vec4 frustumPlanes[6]; };"
+		"layout(std430, binding = " + to_string(VIEW_STORAGE_BINDING) + ") readonly buffer Views { View views[]; };";
+
+	// Multi-view vertex shader source code, the command index selects the instance and the view
+	string multiViewVertexShaderSource =
+		"#version 430 core\n"
+		"layout(location = 0) in vec3 vPosition;"
+		"layout(location = 2) in vec2 texCoord;"
+		"layout(location = 3) in vec3 normal;"
+		"layout(location = 4) in uint instanceIndex;"
+		"struct Instance { mat4 model; vec4 bounds; uint material; uint lodFirst; uint lodCount; uint padding; };"
+		"layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };"
+		+ viewStorageBlockSource +
+		"out vec2 gTexCoord;"
+		"out vec3 gNormal;"
+		"out vec3 gFragPos;"
+		"out vec3 gViewPos;"
+		"flat out int gView;"
+		"uniform uint viewCount;"
+		"void main()\n"
+		"{\n"
+		"uint view = instanceIndex % viewCount;"
+		"mat4 model = instances[instanceIndex / viewCount].model;"
+		"gl_Position = views[view].viewProjection * model * vec4(vPosition, 1.0);"
+		"gNormal = mat3(transpose(inverse(model))) * normal;"
+		"gFragPos = vec3(model * vec4(vPosition, 1.0f));"
+		"gTexCoord = texCoord;"
+		"gViewPos = views[view].viewPos.xyz;"
+		"gView = int(view);"
+		"}\n";
+
+	// Multi-view geometry shader source code, sends each triangle to the layer of its view
+	string multiViewGeometryShaderSource =
+		"#version 430 core\n"
+		"layout(triangles) in;"
+		"layout(triangle_strip, max_vertices = 3) out;"
+		"in vec2 gTexCoord[];"
+		"in vec3 gNormal[];"
+		"in vec3 gFragPos[];"
+		"in vec3 gViewPos[];"
+		"flat in int gView[];"
+		"out vec2 oTexCoord;"
+		"out vec3 oNormal;"
+		"out vec3 fragPos;"
+		"out vec3 oViewPos;"
+		"void main()\n"
+		"{\n"
+		"for (int i = 0; i < 3; i++)"
+		"{"
+		"gl_Layer = gView[0];"
+		"gl_Position = gl_in[i].gl_Position;"
+		"oTexCoord = gTexCoord[i];"
+		"oNormal = gNormal[i];"
+		"fragPos = gFragPos[i];"
+		"oViewPos = gViewPos[i];"
+		"EmitVertex();"
+		"}"
+		"EndPrimitive();"
+		"}\n";
+
+	// Culling compute shader source code, writes one draw command per instance and view with the level of detail selected for that view
+	string cullComputeShaderSource =
+		"#version 430 core\n"
+		"layout(local_size_x = " + to_string(CULL_GROUP_SIZE) + ") in;"
+		"struct Instance { mat4 model; vec4 bounds; uint material; uint lodFirst; uint lodCount; uint padding; };"
+		"struct Lod { uint indexCount; uint firstIndex; float maxDistance; uint padding; };"
+		"struct DrawCommand { uint count; uint instanceCount; uint firstIndex; int baseVertex; uint baseInstance; };"
+		"layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };"
+		"layout(std430, binding = 1) readonly buffer Lods { Lod lods[]; };"
+		"layout(std430, binding = 2) writeonly buffer Commands { DrawCommand commands[]; };"
+		+ viewStorageBlockSource +
+		"uniform uint instanceTotal;"
+		"uniform uint viewCount;"
+		"void main()\n"
+		"{\n"
+		"uint command = gl_GlobalInvocationID.x;"
+		"if (command >= instanceTotal * viewCount) return;"
+		"uint id = command / viewCount;"
+		"uint v = command % viewCount;"
+		"vec4 bounds = instances[id].bounds;"
+		"//Frustum test of the bounding sphere against this command's view\n"
+		"bool visible = true;"
+		"for (int i = 0; i < 6; i++)"
+		"visible = visible && dot(views[v].frustumPlanes[i].xyz, bounds.xyz) + views[v].frustumPlanes[i].w >= -bounds.w;"
+		"float dist = max(distance(views[v].viewPos.xyz, bounds.xyz) - bounds.w, 0.0);"
+		"//Select the first level of detail covering the distance to the camera\n"
+		"uint lod = instances[id].lodFirst;"
+		"bool selected = false;"
+		"for (uint i = 0; i < instances[id].lodCount && !selected; i++)"
+		"{"
+		"lod = instances[id].lodFirst + i;"
+		"selected = dist <= lods[lod].maxDistance;"
+		"}"
+		"commands[command].count = lods[lod].indexCount;"
+		"commands[command].instanceCount = (visible && selected) ? 1u : 0u;"
+		"commands[command].firstIndex = lods[lod].firstIndex;"
+		"commands[command].baseVertex = 0;"
+		"commands[command].baseInstance = command;"
+		"}\n";
+
+	// Create GPU-driven programs, fall back to drawing one plane at a time if the compute shader is unavailable
+	GLuint indirectShaderProgram = 0, multiViewShaderProgram = 0, cullProgram = 0;
+	if (gpuDrivenSupported)
+	{
+		cullProgram = CreateComputeProgram(cullComputeShaderSource);
+		gpuDrivenSupported = cullProgram != 0;
+	}
+	if (gpuDrivenSupported)
+	{
+		indirectShaderProgram = CreateShaderProgram(indirectVertexShaderSource, fragmentShaderSource);
+		multiViewShaderProgram = CreateShaderProgram(multiViewVertexShaderSource, fragmentShaderSource, multiViewGeometryShaderSource);
+	}
+	gpuDriven = gpuDrivenSupported;
+
+	// Say which path is active, a context below 4.3 or a failed compute shader silently means one plane at a time
+	cout << "OpenGL " << glGetString(GL_VERSION) << (gpuDrivenSupported ? ", GPU-driven rendering with compute culling"
+		: ", GPU-driven rendering unavailable, drawing one plane at a time") << endl;
+
+	// Every program reads the per-frame data from the same uniform block binding
+	BindFrameUniformBlock(shaderProgram);
+	if (gpuDrivenSupported)
+	{
+		BindFrameUniformBlock(indirectShaderProgram);
+		BindFrameUniformBlock(multiViewShaderProgram);
+	}
+
+	// Texture used by each material
+	GLuint materialTextures[MATERIAL_COUNT] = { crateTexture, gridTexture };
+
+	// Gather what the GPU-driven and multi-view paths need to draw the scene
+	SceneResources scene;
+	scene.instanceCount = (GLuint)sceneInstances.size();
+	for (GLuint material = 0; material < MATERIAL_COUNT; material++)
+	{
+		scene.materialFirst[material] = materialFirst[material];
+		scene.materialCount[material] = materialCount[material];
+		scene.materialTextures[material] = materialTextures[material];
+	}
+	scene.indirectVAO = indirectVAO;
+	scene.instanceSSBO = instanceSSBO;
+	scene.lodSSBO = lodSSBO;
+	scene.commandBuffer = commandBuffer;
+	scene.cullProgram = cullProgram;
+	scene.multiViewProgram = multiViewShaderProgram;
+
+	// Transient CPU allocations and dynamic GPU data for each frame
+	FrameArena frameArena(64 * 1024);
+	GpuRingBuffer frameRing;
+	frameRing.create(FRAME_RING_BYTES);
+
+	// Render the turntable views or the coordinator's frame ranges offscreen and skip the interactive loop
+	int exitCode = 0;
+	if (offscreen)
+	{
+		if (!gpuDrivenSupported)
+		{
+			cout << "Error! Multi-view rendering needs OpenGL 4.3" << endl;
+			exitCode = -1;
+		}
+		else if (sequenceWorker)
+			exitCode = RunSequenceWorker(scene, frameRing, frameArena, workerFd, workerConfig);
+		else if (!RenderTurntable(scene, frameRing, frameArena, turntableViews, outputWidth, outputHeight, outputPrefix))
+			exitCode = -1;
+		glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
 	
 	/* Loop until the user closes the window */
 	while (!glfwWindowShouldClose(window))
@@ -461,6 +2475,10 @@ int main(void)
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		// Release last frame's transient data and wait until the GPU is done with this frame's ring region
+		frameArena.reset();
+		frameRing.beginFrame();
+
 		// Resize window and graphics simultaneously
 		glfwGetFramebufferSize(window, &width, &height);
 		glViewport(0, 0, width, height);
@@ -468,141 +2486,50 @@ int main(void)
 		/* Render here */
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// Use Shader Program exe and select VAO before drawing 
-		glUseProgram(shaderProgram); 
-		glm::mat4 projectionMatrix;			   		
+		glm::mat4 projectionMatrix;
 		viewMatrix = glm::lookAt(cameraPosition, getTarget(), worldUp);
 		projectionMatrix = glm::perspective(fov, (GLfloat)width / (GLfloat)height, 0.1f, 100.0f);
 
-		// Get matrix's uniform location and set matrix
-		GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-		GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-		GLint projLoc = glGetUniformLocation(shaderProgram, "projection");
-
-		// Get light and object color, and light position location
-		GLint objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
-		GLint lightColorLoc = glGetUniformLocation(shaderProgram, "lightColor");
-		GLint lightPosLoc = glGetUniformLocation(shaderProgram, "lightPos");
-		GLint viewPosLoc = glGetUniformLocation(shaderProgram, "viewPos");
-
-		// Assign Light and Object Colors
-		glUniform3f(objectColorLoc, 0.76f, 0.60f, 0.32f);
-		glUniform3f(lightColorLoc, 1.0f, 1.0f, 1.0f); 
-
-		// Set light position
-		glUniform3f(lightPosLoc, lightPosition.x, lightPosition.y, lightPosition.z);
-
-		// Specify view position
-		glUniform3f(viewPosLoc, cameraPosition.x, cameraPosition.y, cameraPosition.z);
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-		glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
-
-		glBindTexture(GL_TEXTURE_2D, crateTexture); 
-		glBindVertexArray(cubeVAO);  
-
-		// Create back right leg for chair
-		for (GLuint i = 0; i < 4; i++)
-		{
-			glm::mat4 modelMatrix;
-			modelMatrix = glm::translate(modelMatrix, planePositions[i]);
-			modelMatrix = glm::rotate(modelMatrix, planeRotations[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.50f, 5.5f, 0.50f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-			draw();
-		}
-		glBindVertexArray(0); 
-
-		glBindTexture(GL_TEXTURE_2D, crateTexture); 
-		glBindVertexArray(cubeVAO); 
-		
-		// Create back left leg for chair
-		for (GLuint i = 0; i < 4; i++)
-		{
-			glm::mat4 modelMatrix;
-			modelMatrix = glm::translate(modelMatrix, planePositions2[i]);
-			modelMatrix = glm::rotate(modelMatrix, planeRotations[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.50f, 5.5f, 0.50f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-			draw();
-		}
-		glBindVertexArray(0); 
-	
-		glBindTexture(GL_TEXTURE_2D, crateTexture); 
-		glBindVertexArray(cubeVAO);  
-
-		// Create front left leg of chair
-		for (GLuint i = 0; i < 4; i++)
-		{
-			glm::mat4 modelMatrix;
-			modelMatrix = glm::translate(modelMatrix, planePositions3[i]);
-			modelMatrix = glm::rotate(modelMatrix, planeRotations[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.50f, 3.0f, 0.50f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-			draw();
-		}
-		glBindVertexArray(0); 
-
-		glBindTexture(GL_TEXTURE_2D, crateTexture); 
-		glBindVertexArray(cubeVAO); 
-
-		// Create back left leg of chair
-		for (GLuint i = 0; i < 4; i++)
-		{
-			glm::mat4 modelMatrix;
-			modelMatrix = glm::translate(modelMatrix, planePositions4[i]);
-			modelMatrix = glm::rotate(modelMatrix, planeRotations[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.50f, 3.0f, 0.50f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-			draw();
-		}
-		glBindVertexArray(0); 
-		
-		glBindTexture(GL_TEXTURE_2D, crateTexture); 
-		glBindVertexArray(cubeVAO);  
+		// Write view, light and object colors into the ring buffer, the frame is skipped if the ring region is full
+		FrameUniforms frameUniforms;
+		bool frameWritten = WriteFrameUniforms(frameRing, viewMatrix, projectionMatrix, cameraPosition, frameUniforms);
 
-		// Create chair seat
-		for (GLuint i = 0; i < 6; i++)
+		if (frameWritten && gpuDriven)
 		{
-			glm::mat4 modelMatrix;
-			modelMatrix = glm::translate(modelMatrix, planePositions5[i]);
-			modelMatrix = glm::rotate(modelMatrix, planeRotations3[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(2.1f, 0.45f, 2.50f));
-			if (i >= 4)
-				modelMatrix = glm::rotate(modelMatrix, planeRotations3[i] * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-			draw();
+			// Cull instances and select levels of detail on the GPU for the single camera
+			if (WriteViews(frameRing, frameArena, projectionMatrix, &cameraPosition, 1))
+			{
+				CullScene(scene, 1);
+
+				// One multi draw per material, the model matrix comes from the instance SSBO
+				glUseProgram(indirectShaderProgram);
+				glBindVertexArray(indirectVAO);
+				DrawScene(scene, 1);
+				glBindVertexArray(0);
+			}
 		}
-		glBindVertexArray(0); 
-				
-		glBindTexture(GL_TEXTURE_2D, crateTexture); 
-		glBindVertexArray(cubeVAO); 
-        
-		// Chair Back
-		for (GLuint i = 0; i < 3; i++)
+		else if (frameWritten)
 		{
-			glm::mat4 modelMatrix;
-			modelMatrix = glm::translate(modelMatrix, planePositions6[i]);
-			modelMatrix = glm::rotate(modelMatrix, planeRotations2[i] * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(2.5f, 1.85f, 1.0f));
-			if (i >= 2) {
-				modelMatrix = glm::rotate(modelMatrix, planeRotations2[i] * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
-				modelMatrix = glm::scale(modelMatrix, glm::vec3(0.20f, 2.5f, 1.0f));					
+			// Cull on the CPU into a visible list that only lives for this frame
+			GLuint* visible = frameArena.allocate<GLuint>(sceneInstances.size());
+			GLuint visibleCount = 0;
+			for (GLuint i = 0; i < sceneInstances.size(); i++)
+				if (SphereInFrustum(sceneInstances[i].bounds, frameUniforms.frustumPlanes))
+					visible[visibleCount++] = i;
+
+			// Draw the visible planes one at a time
+			glUseProgram(shaderProgram);
+			GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
+			glBindVertexArray(cubeVAO);
+			for (GLuint i = 0; i < visibleCount; i++)
+			{
+				const SceneInstance& instance = sceneInstances[visible[i]];
+				glBindTexture(GL_TEXTURE_2D, materialTextures[instance.material]);
+				glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(instance.model));
+				draw();
 			}
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-			draw();
+			glBindVertexArray(0);
 		}
-		glBindVertexArray(0); 
-		
-		// Create grid textured floor
-		glBindTexture(GL_TEXTURE_2D, gridTexture); 
-		glBindVertexArray(floorVAO);
-		glm::mat4 modelMatrix;
-		modelMatrix = glm::translate(modelMatrix, glm::vec3(-.4f, -0.75f, 0.1f));
-		modelMatrix = glm::rotate(modelMatrix, 90.f * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
-		modelMatrix = glm::scale(modelMatrix, glm::vec3(5.f, 5.f, 5.f));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-		draw();
-		glBindVertexArray(0); 
 		glUseProgram(0); 
 
 		// Used to display the light source for adjusting lighting
@@ -639,6 +2566,15 @@ int main(void)
 
 		glUseProgram(0);
 		*/
+
+		// Fence this frame's ring region after every command that reads it
+		frameRing.endFrame();
+
+		if (printStats)
+		{
+			PrintFrameStats(frameArena, frameRing);
+			printStats = false;
+		}
 						 
 		glfwSwapBuffers(window);
 		glfwPollEvents();
@@ -646,15 +2582,28 @@ int main(void)
 	}
 
 	//Clear GPU resources
+	frameRing.destroy();
 	glDeleteVertexArrays(1, &cubeVAO);
 	glDeleteBuffers(1, &cubeVBO);
 	glDeleteBuffers(1, &cubeEBO);
-	glDeleteVertexArrays(1, &floorVAO);
-	glDeleteBuffers(1, &floorVBO);
-	glDeleteBuffers(1, &floorEBO);
+	glDeleteVertexArrays(1, &lampVAO);
+	glDeleteBuffers(1, &lampVBO);
+	glDeleteBuffers(1, &lampEBO);
+
+	if (gpuDrivenSupported)
+	{
+		glDeleteVertexArrays(1, &indirectVAO);
+		glDeleteBuffers(1, &instanceIndexVBO);
+		glDeleteBuffers(1, &instanceSSBO);
+		glDeleteBuffers(1, &lodSSBO);
+		glDeleteBuffers(1, &commandBuffer);
+		glDeleteProgram(cullProgram);
+		glDeleteProgram(indirectShaderProgram);
+		glDeleteProgram(multiViewShaderProgram);
+	}
 	
 	glfwTerminate();
-	return 0;
+	return exitCode;
 }
 
 // Define input functions
@@ -664,6 +2613,14 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GL_TRUE);
 
+	// Switch between GPU-driven and per plane drawing
+	if (key == GLFW_KEY_G && action == GLFW_PRESS && gpuDrivenSupported)
+		gpuDriven = !gpuDriven;
+
+	// Print frame allocator and ring buffer statistics
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+		printStats = true;
+
 	// Assign true to Element ASCII if key pressed
 	if (action == GLFW_PRESS)
 		keys[key] = true;
@@ -758,10 +2715,16 @@ void initiateCamera()
 	CameraFront = glm::vec3(0.0f, 0.0f, -1.0f); 
 }
 
+// Position on the orbit around the object at an angle in radians
+glm::vec3 orbitPosition(GLfloat angle)
+{
+	return glm::vec3(0.0f, 1.0f, 0.0f) + glm::vec3(3.5f * sin(angle), 0.0f, 3.5f * cos(angle));
+}
+
 // Rotate camera around object
 void spinCamera()
 {
-	cameraPosition = glm::vec3(0.0f, 1.0f, 0.0f) + glm::vec3(3.5f * sin(glfwGetTime()), 0.0f, 3.5f * cos(glfwGetTime()));
+	cameraPosition = orbitPosition(glfwGetTime());
 	target = glm::vec3(-0.375f, 0.5f, 0.4);
 	cameraDirection = glm::normalize(cameraPosition - cameraDirection);
 	worldUp = glm::vec3(0.0, 1.0f, 0.0f);